@@ -67,12 +67,71 @@ public:
     }
 
 
+    // memory accounting functions
+
+    /* Returns the number of bytes allocated on the heap by the strings of the employee.
+     * Strings short enough to be stored inside the object itself do not count.
+     * */
+    size_t getStringBytes() const {
+        return stringBytes(m_name) + stringBytes(m_surname) + stringBytes(m_email);
+    }
+
+    /* Returns the number of heap bytes allocated by the strings of the employee,
+     * that are not used by their content.
+     * */
+    size_t getStringSlack() const {
+        return stringSlack(m_name) + stringSlack(m_surname) + stringSlack(m_email);
+    }
+
+
 private:
     // Fields that describe an employee
     string m_name;
     string m_surname;
     string m_email;
     unsigned int m_salary;
+
+
+    // Additional functions
+
+    /* Function that checks whether the content of the string
+     * is stored inside the string object (small string optimization).
+     * */
+    static bool isInline(const string &str) {
+        const char *data = str.data();
+        const char *object = reinterpret_cast<const char *>(&str);
+        // The buffer may be on the heap, so the pointers are compared
+        // with the function objects, which guarantee a strict total order.
+        return greater_equal<const char *>()(data, object)
+               && less<const char *>()(data, object + sizeof(string));
+    }
+
+    /* The heap buffer is assumed to take capacity() + 1 bytes,
+     * which holds for libstdc++ and libc++.
+     * */
+
+    static size_t stringBytes(const string &str) {
+        return isInline(str) ? 0 : str.capacity() + 1;
+    }
+
+    static size_t stringSlack(const string &str) {
+        return isInline(str) ? 0 : str.capacity() - str.size();
+    }
+};
+
+/* A structure that describes the memory used by the CPersonalAgenda.
+ * All values are in bytes.
+ * */
+struct CMemoryStats {
+    size_t m_records = 0; // Records in the vector sorted by full name
+    size_t m_strings = 0; // Heap buffers of the names, surnames and emails
+    size_t m_indexes = 0; // Records in the vector sorted by email
+    size_t m_vectorSlack = 0; // Allocated, but unused capacity of the vectors
+    size_t m_stringSlack = 0; // Allocated, but unused capacity of the strings
+
+    size_t total() const {
+        return m_records + m_strings + m_indexes + m_vectorSlack + m_stringSlack;
+    }
 };
 
 /* The CPersonalAgenda class implements a database of employees
@@ -432,6 +491,36 @@ public:
         }
     }
 
+    /* The method calculates how much memory is used by the database.
+     * Heap buffers of the strings are counted in m_strings, except for
+     * their unused capacity, which is counted in m_stringSlack.
+     * */
+    CMemoryStats memoryStats() const {
+        CMemoryStats stats;
+        stats.m_records = m_databaseByFullName.size() * sizeof(CPerson);
+        stats.m_indexes = m_databaseByEmail.size() * sizeof(CPerson);
+        stats.m_vectorSlack = (m_databaseByFullName.capacity() - m_databaseByFullName.size()
+                               + m_databaseByEmail.capacity() - m_databaseByEmail.size()) * sizeof(CPerson);
+        addStringStats(m_databaseByFullName, stats);
+        addStringStats(m_databaseByEmail, stats);
+        return stats;
+    }
+
+    /* The method rebuilds the database so that the vectors and strings
+     * take only as much memory as the current records need.
+     * The new storage is built aside and then swapped in, so if the allocation
+     * fails, the database keeps its old storage and stays unchanged.
+     * The rebuild runs on the calling thread and blocks it. It takes time and
+     * extra memory proportional to the number of records, since both copies exist
+     * until the swap. CPersonalAgenda is not safe to use from several threads at once.
+     * */
+    void compact() {
+        vector<CPerson> byFullName = rebuild(m_databaseByFullName);
+        vector<CPerson> byEmail = rebuild(m_databaseByEmail);
+        m_databaseByFullName.swap(byFullName);
+        m_databaseByEmail.swap(byEmail);
+    }
+
 private:
     /* For binary search, two vectors have been implemented
      * that store ordered records by full name and email.
@@ -485,6 +574,26 @@ private:
         return posByFullName;
     }
 
+    /* Function that copies the records into a new vector without unused capacity.
+     * Copying a string allocates only as much memory as its content needs.
+     * */
+    static vector<CPerson> rebuild(const vector<CPerson> &database) {
+        vector<CPerson> result;
+        result.reserve(database.size());
+        for (const CPerson &person: database) {
+            result.push_back(person);
+        }
+        return result;
+    }
+
+    // Function that adds the heap memory used by the strings of the records to stats.
+    static void addStringStats(const vector<CPerson> &database, CMemoryStats &stats) {
+        for (const CPerson &person: database) {
+            stats.m_strings += person.getStringBytes() - person.getStringSlack();
+            stats.m_stringSlack += person.getStringSlack();
+        }
+    }
+
     // Functions that compare email or full name
     int compare(const string &email1, const string &email2) const {
         return email1.compare(email2);
@@ -665,6 +774,40 @@ int main(void) {
     assert (b2.add("Peter", "Smith", "peter", 40000));
     assert (b2.getSalary("peter") == 40000);
 
+    CPersonalAgenda b3;
+    assert (b3.memoryStats().total() == 0);
+    for (int i = 0; i < 100; i++) {
+        string id = to_string(i);
+        assert (b3.add("Name" + id, "A rather long surname number " + id,
+                       "a.rather.long.email.address." + id + "@example.com", 1000 + i));
+    }
+    for (int i = 0; i < 90; i++) {
+        assert (b3.del("a.rather.long.email.address." + to_string(i) + "@example.com"));
+    }
+    CMemoryStats before = b3.memoryStats();
+    assert (before.m_records == 10 * sizeof(CPerson));
+    assert (before.m_indexes == 10 * sizeof(CPerson));
+    assert (before.m_strings > 0);
+    assert (before.m_vectorSlack >= 180 * sizeof(CPerson));
+    assert (before.m_stringSlack > 0);
+    b3.compact();
+    CMemoryStats after = b3.memoryStats();
+    assert (after.m_records == before.m_records);
+    assert (after.m_indexes == before.m_indexes);
+    assert (after.m_strings == before.m_strings);
+    assert (after.m_vectorSlack == 0);
+    assert (after.m_stringSlack == 0);
+    assert (after.total() < before.total());
+    assert (b3.getSalary("Name95", "A rather long surname number 95") == 1095);
+    assert (b3.getFirst(outName, outSurname)
+            && outName == "Name90"
+            && outSurname == "A rather long surname number 90");
+    assert (b3.del("Name95", "A rather long surname number 95"));
+    assert (b3.add("Name0", "A rather long surname number 0", "john", 500));
+    assert (b3.getRank("john", lo, hi)
+            && lo == 0
+            && hi == 0);
+
     return EXIT_SUCCESS;
 }
 